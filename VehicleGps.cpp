@@ -20,6 +20,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "VehicleGps.h"
 
+// hex ascii to nibble, 0xFF marks characters that are not hex digits
+static const byte hex_table[256] PROGMEM = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
 //------------
 // Constructor
 //------------
@@ -34,10 +54,11 @@ VehicleGps::VehicleGps(){
   latitude = GPS_INVALID_FLOAT;
   longitude = GPS_INVALID_FLOAT;
   altitude = GPS_INVALID_FLOAT;
-  speed = 2.699;//GPS_INVALID_FLOAT;
+  speed = GPS_INVALID_FLOAT;
   course = GPS_INVALID_FLOAT;
   xte = 0;
   quality = 0;
+  accuracy = GPS_INVALID_FLOAT;
 
   // Timekeepers
   last_GGA_fix = 0;
@@ -52,8 +73,21 @@ VehicleGps::VehicleGps(){
   sum = 0;
   checksum = 0;
   is_checksum_term = false;
+  is_trimble = false;
+  term_error = false;
   sentence_type = OTHER;
 
+  // Binary frame internal variables
+  frame_state = NO_FRAME;
+  frame_length = 0;
+  frame_offset = 0;
+  frame_value = 0;
+  ck_a = 0;
+  ck_b = 0;
+  ubx_valid = 0;
+  rtcm_frames = 0;
+  rtcm_type = 0;
+
 #ifndef GPS_NO_STATS
   // Statistics
   encoded_characters = 0;
@@ -113,17 +147,114 @@ bool VehicleGps::strcmp(const char *_str1, const char *_str2) {
   return false;
 }
 
-// ------------------------------------------
-// Method for converting hex ascii to integer
-// ------------------------------------------
+// ------------------------------------------------------------
+// Method for converting hex ascii to integer, 0xFF if not hex
+// ------------------------------------------------------------
 byte VehicleGps::hexToInt(char _c) {
-  // Parse hex
-  if (_c >= 'A' && _c <= 'F')
-    return _c - 'A' + 10;
-  else if (_c >= 'a' && _c <= 'f')
-    return _c - 'a' + 10;
-  else
-    return _c - '0';
+  return pgm_read_byte(&hex_table[byte(_c)]);
+}
+
+// ---------------------------------------------------------------
+// Method for converting pairs of hex ascii to bytes
+// Returns false if any character, including '\0', is not hex
+// ---------------------------------------------------------------
+bool VehicleGps::hexToBytes(const char *_c, byte *_out, byte _count) {
+  byte _invalid = 0;
+
+  // invalid characters set the high nibble, checked once at the end
+  for (byte i = 0; i < _count; i++) {
+    byte _high = hexToInt(*_c++);
+    byte _low = hexToInt(*_c++);
+    _invalid |= _high | _low;
+    _out[i] = (_high << 4) | (_low & 0x0F);
+  }
+  return !(_invalid & 0xF0);
+}
+
+// ----------------------------------------------------------------
+// Method for committing the new_ values of a validated sentence
+// Shared by the NMEA, Trimble, CAN and binary UBX decoders
+// ----------------------------------------------------------------
+void VehicleGps::commitSentence() {
+#ifndef GPS_NO_STATS
+  good_sentences++;
+#endif
+  switch (sentence_type) {
+  case GGA:
+    altitude = new_altitude;
+    time = new_time;
+    latitude = new_latitude;
+    longitude = new_longitude;
+    quality = new_quality;
+    last_GGA_fix = millis();
+    break;
+  case VTG:
+    course = new_course;
+    speed = new_speed;
+    last_VTG_fix = millis();
+    break;
+  case XTE:
+  case XTE2:
+    xte = new_xte;
+    last_XTE_fix = millis();
+    break;
+  case CAN_POS:
+    latitude = new_latitude;
+    longitude = new_longitude;
+    last_GGA_fix = millis();
+    break;
+  case CAN_SPD:
+    course = new_course;
+    speed = new_speed;
+    altitude = new_altitude;
+    last_VTG_fix = millis();
+    break;
+  case CAN_XTE:
+    xte = new_xte;
+    quality = new_quality;
+    last_XTE_fix = millis();
+    break;
+  case UBX_PVT:
+    if (ubx_valid & UBX_VALID_DATE)
+      date = new_date;
+    if (ubx_valid & UBX_VALID_TIME)
+      time = new_time;
+    quality = new_quality;
+    // without a fix the receiver sends placeholders, keep the last values
+    if (!quality)
+      break;
+    latitude = new_latitude;
+    longitude = new_longitude;
+    altitude = new_altitude;
+    accuracy = new_accuracy;
+    course = new_course;
+    speed = new_speed;
+    last_GGA_fix = last_VTG_fix = millis();
+    break;
+  case OTHER:
+    break;
+  }
+
+  // feed the smoothing filter, velocity first so positions see it is fresh
+  switch (sentence_type) {
+  case VTG:
+  case CAN_SPD:
+    filter.addVelocity(speed, course, last_VTG_fix);
+    break;
+  case UBX_PVT:
+    if (!quality)
+      break;
+    filter.addVelocity(speed, course, last_VTG_fix);
+  case GGA:
+    // no fix, position terms are empty or stale
+    if (!quality)
+      break;
+  case CAN_POS:
+    filter.addPosition(latitude, longitude, last_GGA_fix);
+    break;
+  default:
+    break;
+  }
 }
 
 // ---------------------------------------------------------------------------
@@ -132,53 +263,10 @@ byte VehicleGps::hexToInt(char _c) {
 // ---------------------------------------------------------------------------
 bool VehicleGps::parseTerm() {
   if (is_checksum_term) {
-    if (sentence_type == XTE2) {
-      //checksum already checked in feedgps() for Trimble strings...
-      checksum = parity;
-    }
-    else {
-      // Process checksum and update state
-      checksum = (hexToInt(term[0]) << 4) + hexToInt(term[1]);
-    }
-    if (checksum == parity) {
-#ifndef GPS_NO_STATS
-      good_sentences++;
-#endif
-      switch (sentence_type) {
-      case GGA:
-        altitude = new_altitude;
-        time = new_time;
-        latitude = new_latitude;
-        longitude = new_longitude;
-        quality = new_quality;
-        last_GGA_fix = millis();
-        break;
-      case VTG:
-        course = new_course;
-        speed = new_speed;
-        last_VTG_fix = millis();
-        break;
-      case XTE:
-      case XTE2:
-        xte = new_xte;
-        last_XTE_fix = millis();
-        break;
-      case CAN_POS:
-        latitude = new_latitude;
-        longitude = new_longitude;
-        last_GGA_fix = millis();
-        break;
-      case CAN_SPD:
-        course = new_course;
-        speed = new_speed;
-        altitude = new_altitude;
-        last_VTG_fix = millis();
-        break;
-      case CAN_XTE:
-        xte = new_xte;
-        quality = new_quality;
-        last_XTE_fix = millis();
-      }
+    // Process checksum and update state, trimble framing carries no parity
+    // a malformed term fails the sentence even if the checksum matches
+    if (!is_trimble && !term_error && hexToBytes(term, &checksum, 1) && checksum == parity) {
+      commitSentence();
       return true;
     }
 #ifndef GPS_NO_STATS
@@ -277,6 +365,11 @@ bool VehicleGps::parseTerm() {
       case 3: // XTE
         new_xte = parseDecimal(term) * 100;
         break;
+      case 4: // Direction to steer, R is negative
+        if (term[0] == 'R') {
+          new_xte = -new_xte;
+        }
+        break;
       }
       break;
     case XTE2:
@@ -289,15 +382,14 @@ bool VehicleGps::parseTerm() {
     case CAN_POS:
       switch (term_number) {
       case 1: // CAN Position
-        unsigned long int val1 = 0;
-        unsigned long int val2 = 0;
-        
-        for (int i = 7; i >= 0; i-=2){
-          val1 = (val1 << 8) + (hexToInt(term[i-1]) << 4) + hexToInt(term[i]);
-        }
-        for (int i = 15; i >= 8; i-=2){
-          val2 = (val2 << 8) + (hexToInt(term[i-1]) << 4) + hexToInt(term[i]);
+        byte data[8];
+        if (!hexToBytes(term, data, 8)) {
+          term_error = true;
+          break;
         }
+        unsigned long int val1 = ((unsigned long)word(data[3], data[2]) << 16) + word(data[1], data[0]);
+        unsigned long int val2 = ((unsigned long)word(data[7], data[6]) << 16) + word(data[5], data[4]);
+        
         val1 = val1 - 2100000000;
         val2 = val2 - 2100000000;
         
@@ -315,14 +407,20 @@ bool VehicleGps::parseTerm() {
     case CAN_SPD:
       switch (term_number) {
       case 1: // CAN Speed
-        unsigned int val = (hexToInt(term[2]) << 12) + (hexToInt(term[3]) << 8) + (hexToInt(term[0]) << 4) + hexToInt(term[1]);
-        new_course = float(val) / 128;
+        byte data[8];
+        if (!hexToBytes(term, data, 8)) {
+          term_error = true;
+          break;
+        }
+        // FFFF is "not available", keep the committed value
+        unsigned int val = word(data[1], data[0]);
+        new_course = val == 0xFFFF ? course : float(val) / 128;
         
-        val = (hexToInt(term[6]) << 12) + (hexToInt(term[7]) << 8) + (hexToInt(term[4]) << 4) + hexToInt(term[5]);
-        new_speed = float(val) / 256;
+        val = word(data[3], data[2]);
+        new_speed = val == 0xFFFF ? speed : float(val) / 256;
         
-        val = (hexToInt(term[14]) << 12) + (hexToInt(term[15]) << 8) + (hexToInt(term[12]) << 4) + hexToInt(term[13]);
-        new_altitude = float(val) / 8 - 2500;
+        val = word(data[7], data[6]);
+        new_altitude = val == 0xFFFF ? altitude : float(val) / 8 - 2500;
 #ifdef DEBUG
         Serial.print("Course: ");
         Serial.println(new_course, 4);
@@ -337,10 +435,15 @@ bool VehicleGps::parseTerm() {
     case CAN_XTE:
       switch (term_number) {
       case 1: // CAN XTE John Deere
-        unsigned int val = (hexToInt(term[8]) << 12) + (hexToInt(term[9]) << 8) + (hexToInt(term[6]) << 4) + hexToInt(term[7]) - 32000;
+        byte data[5];
+        if (!hexToBytes(term, data, 5)) {
+          term_error = true;
+          break;
+        }
+        unsigned int val = word(data[4], data[3]) - 32000;
         new_xte = int(val) >> 1;
         
-        if (term[2] == '1'){
+        if ((data[1] >> 4) == 1){
           new_quality = 4;
         }
 #ifdef DEBUG
@@ -352,6 +455,7 @@ bool VehicleGps::parseTerm() {
         break;
       }
       break;
+    case UBX_PVT:
     case OTHER:
       break;
     }
@@ -359,6 +463,339 @@ bool VehicleGps::parseTerm() {
   return false;
 }
 
+// ---------------------------------------------------------------
+// Method for routing a received byte to the ASCII or binary parser
+// Returns true if a sentence or frame has just been validated
+// ---------------------------------------------------------------
+bool VehicleGps::parseByte(byte _c) {
+  // binary frame in progress
+  if (frame_state != NO_FRAME)
+    return parseBinary(_c);
+
+  // binary sync characters never occur in ASCII NMEA
+  if (_c == UBX_SYNC1) {
+    frame_state = UBX_SYNC;
+    return false;
+  }
+  if (_c == RTCM3_PREAMBLE) {
+    frame_state = RTCM_LENGTH1;
+    return false;
+  }
+  return parseChar(_c);
+}
+
+// --------------------------------------------------
+// Method for decoding ASCII NMEA and Trimble framing
+// --------------------------------------------------
+bool VehicleGps::parseChar(char _c) {
+  bool _valid_sentence = false;
+
+  //start decoding, split sentence into terms separated by ","', "/r", "/n", "*" or "$".
+  //only the checksum of the framing in use is kept, parity for NMEA, sum for trimble
+  switch (byte(_c)) {
+  // trimble id (reset sum)
+  case 191:
+    term_number = term_offset = 0;
+    sum = 0;
+    is_trimble = true;
+    break;
+  // sentence start
+  case '$':
+  case '@':
+    // trimble framing only when directly preceded by the trimble id
+    if (is_trimble && (term_number || term_offset))
+      is_trimble = false;
+    // sentence begin, reset decoding process
+    term_number = term_offset = 0;
+    parity = 0;
+    if (is_trimble)
+      sum += byte(_c);
+    sentence_type = OTHER;
+    is_checksum_term = false;
+    term_error = false;
+    break;
+  // bitbucket for unwanted trimble and in NMEA unused characters
+  case 20:
+  case 0:
+  case ' ':
+    if (is_trimble)
+      sum += byte(_c);
+    break;
+  // term terminators, decode term by term
+  case ',':
+    if (!is_trimble)
+      parity ^= _c;
+  case ':':
+  case '*':
+  case '\r':
+  case '\n':
+    if (is_trimble)
+      sum += byte(_c);
+    term[term_offset] = '\0';
+    // pass completed term off to processing
+    _valid_sentence = parseTerm();
+    // reset parsing state for new term
+    term_number++;
+    term_offset = 0;
+    is_checksum_term = _c == '*';
+    break;
+  // trimble specific term terminator and parity check
+  // ascii 3 is terminator when preceded by ascii 16
+  // last 3 digits before ascii 3 are: number of characters send
+  // 2 byte hex sum of all characters after trimble id 
+  case 3:
+    if (is_trimble && term_offset >= 3 && term[term_offset - 1] == 16 && !is_checksum_term) {
+      sum -= byte(term[term_offset - 1]);
+      sum -= byte(term[term_offset - 2]);
+      sum -= byte(term[term_offset - 3]);
+    
+      // check trimble checksum
+      if (sum - byte(term[term_offset - 2]) - (256 * byte(term[term_offset - 3])) == 0) {
+        term[term_offset - 3] = '\0';
+        parseTerm();
+        is_checksum_term = true;
+        if (!term_error) {
+          commitSentence();
+          _valid_sentence = true;
+        }
+      }
+      term_number++;
+      term_offset = 0;
+      break;
+    }
+    else {
+      // ordinary character
+    }
+  // ordinary characters
+  default:
+    if (term_offset < sizeof (term) - 1)
+      term[term_offset++] = _c;
+    if (is_trimble)
+      sum += byte(_c);
+    else if (!is_checksum_term)
+      parity ^= _c;
+    break;
+  }
+  return _valid_sentence;
+}
+
+// --------------------------------------------------------------------
+// Method for decoding UBX and RTCM 3 framing, UBX NAV-PVT is decoded
+// on the fly, other UBX messages are skipped and RTCM 3 frames counted
+// --------------------------------------------------------------------
+bool VehicleGps::parseBinary(byte _c) {
+  switch (frame_state) {
+  // second sync character, replay first one as ASCII if it is missing
+  case UBX_SYNC:
+    frame_state = NO_FRAME;
+    if (_c != UBX_SYNC2) {
+      parseChar(UBX_SYNC1);
+      return parseByte(_c);
+    }
+    frame_state = UBX_CLASS;
+    ck_a = ck_b = 0;
+    return false;
+  case UBX_CLASS:
+    frame_value = _c;
+    frame_state = UBX_ID;
+    break;
+  case UBX_ID:
+    frame_value = (frame_value << 8) | _c;
+    frame_state = UBX_LENGTH1;
+    break;
+  case UBX_LENGTH1:
+    frame_length = _c;
+    frame_state = UBX_LENGTH2;
+    break;
+  case UBX_LENGTH2:
+    frame_length |= _c << 8;
+    frame_offset = 0;
+    if (frame_length > UBX_MAX_LENGTH) {
+      // lost sync, wait for the next sync characters
+      frame_state = NO_FRAME;
+      return false;
+    }
+    if (frame_value == ((UBX_NAV_PVT_CLASS << 8) | UBX_NAV_PVT_ID) &&
+        frame_length == UBX_NAV_PVT_LENGTH)
+      sentence_type = UBX_PVT;
+    else
+      sentence_type = OTHER;
+    frame_state = frame_length ? UBX_PAYLOAD : UBX_CK_A;
+    break;
+  case UBX_PAYLOAD:
+    if (sentence_type == UBX_PVT)
+      parseUbxPvt(_c);
+    if (++frame_offset == frame_length)
+      frame_state = UBX_CK_A;
+    break;
+  // fletcher checksum over class, id, length and payload
+  case UBX_CK_A:
+    if (_c == ck_a) {
+      frame_state = UBX_CK_B;
+    }
+    else {
+#ifndef GPS_NO_STATS
+      failed_checksum++;
+#endif
+      frame_state = NO_FRAME;
+      sentence_type = OTHER;
+    }
+    return false;
+  case UBX_CK_B:
+    frame_state = NO_FRAME;
+    // ascii parser restarts at the next '$'
+    term_number = term_offset = 0;
+    is_checksum_term = false;
+    if (_c == ck_b) {
+      commitSentence();
+      sentence_type = OTHER;
+      return true;
+    }
+#ifndef GPS_NO_STATS
+    failed_checksum++;
+#endif
+    sentence_type = OTHER;
+    return false;
+
+  // rtcm 3, 6 reserved zero bits and 10 bit length
+  case RTCM_LENGTH1:
+    frame_state = NO_FRAME;
+    if (_c & 0xFC) {
+      parseChar(RTCM3_PREAMBLE);
+      return parseByte(_c);
+    }
+    frame_value = 0;
+    rtcmCrc(RTCM3_PREAMBLE);
+    rtcmCrc(_c);
+    frame_length = (_c & 0x03) << 8;
+    frame_state = RTCM_LENGTH2;
+    return false;
+  case RTCM_LENGTH2:
+    rtcmCrc(_c);
+    frame_length |= _c;
+    frame_offset = 0;
+    frame_state = frame_length ? RTCM_PAYLOAD : RTCM_CRC;
+    return false;
+  case RTCM_PAYLOAD:
+    rtcmCrc(_c);
+    // message type is the first 12 bits of the payload
+    if (frame_offset == 0)
+      ck_a = _c;
+    else if (frame_offset == 1)
+      ck_b = _c;
+    if (++frame_offset == frame_length) {
+      frame_offset = 0;
+      frame_state = RTCM_CRC;
+    }
+    return false;
+  // crc-24q, compare byte by byte most significant first
+  case RTCM_CRC:
+    if (_c != byte(frame_value >> (16 - 8 * frame_offset))) {
+#ifndef GPS_NO_STATS
+      failed_checksum++;
+#endif
+      frame_state = NO_FRAME;
+    }
+    else if (++frame_offset == 3) {
+      rtcm_frames++;
+      if (frame_length >= 2)
+        rtcm_type = (ck_a << 4) | (ck_b >> 4);
+      frame_state = NO_FRAME;
+    }
+    return false;
+  case NO_FRAME:
+    break;
+  }
+
+  // running ubx checksum
+  ck_a += _c;
+  ck_b += ck_a;
+  return false;
+}
+
+// ---------------------------------------------------------------
+// Method for decoding UBX NAV-PVT payload, fields are little endian
+// and handled when their last byte arrives
+// ---------------------------------------------------------------
+void VehicleGps::parseUbxPvt(byte _c) {
+  frame_value = (frame_value >> 8) | ((unsigned long)_c << 24);
+
+  switch (frame_offset) {
+  case 5: // Year
+    new_date = (frame_value >> 16) % 100;
+    break;
+  case 6: // Month
+    new_date += _c * 100UL;
+    break;
+  case 7: // Day
+    new_date += _c * 10000UL;
+    break;
+  case 8: // Hour
+    new_time = _c * 10000UL;
+    break;
+  case 9: // Minute
+    new_time += _c * 100;
+    break;
+  case 10: // Second
+    new_time += _c;
+    break;
+  case 11: // Validity flags
+    ubx_valid = _c;
+    break;
+  case 19: // Nanoseconds
+    if (long(frame_value) > 0)
+      new_time += float(long(frame_value) / 10000000) / 100;
+    break;
+  case 20: // Fix type
+    new_quality = _c;
+    break;
+  case 21: // Flags, mapped onto GGA fix quality
+    if (new_quality == 1)
+      new_quality = 6;
+    else if (!(_c & 0x01) || new_quality < 2 || new_quality > 4)
+      new_quality = 0;
+    else if ((_c >> 6) == 2)
+      new_quality = 4;
+    else if ((_c >> 6) == 1)
+      new_quality = 5;
+    else if (_c & 0x02)
+      new_quality = 2;
+    else
+      new_quality = 1;
+    break;
+  case 27: // Longitude 1e-7 degrees
+    new_longitude = float(long(frame_value)) / 10000000;
+    break;
+  case 31: // Latitude 1e-7 degrees
+    new_latitude = float(long(frame_value)) / 10000000;
+    break;
+  case 39: // Height above mean sea level in mm
+    new_altitude = float(long(frame_value)) / 1000;
+    break;
+  case 43: // Horizontal accuracy in mm
+    new_accuracy = float(frame_value) / 1000;
+    break;
+  case 63: // Ground speed in mm/s
+    new_speed = float(long(frame_value)) / 1000 / GPS_MS_PER_KNOT;
+    break;
+  case 67: // Heading of motion 1e-5 degrees
+    new_course = float(long(frame_value)) / 100000;
+    break;
+  }
+}
+
+// ------------------------------------------------------
+// Method for updating the running CRC-24Q of an RTCM frame
+// ------------------------------------------------------
+void VehicleGps::rtcmCrc(byte _c) {
+  frame_value ^= (unsigned long)_c << 16;
+  for (byte i = 0; i < 8; i++) {
+    frame_value <<= 1;
+    if (frame_value & 0x1000000)
+      frame_value ^= 0x1864CFB;
+  }
+}
+
 //--------------------------------------
 //public member functions implementation
 //--------------------------------------
@@ -368,16 +805,14 @@ bool VehicleGps::parseTerm() {
 // ------------------------------------------------
 bool VehicleGps::update() {
   // temporary variables
-  char _c;
   bool _valid_sentence = false;
-  //byte _t = 0;
 
 #if defined(__AVR_ATmega32U4__)   
   while(Serial1.available()){
-    _c = Serial1.read();
+    byte _c = Serial1.read();
 #else
   while(Serial.available()){
-    _c = Serial.read();
+    byte _c = Serial.read();
 #endif
 
 #ifndef GPS_NO_STATS
@@ -385,78 +820,8 @@ bool VehicleGps::update() {
     encoded_characters++;
 #endif
 
-    //start decoding, split sentence into terms separated by ","', "/r", "/n", "*" or "$".
-    switch (_c) {
-    // trimble id (reset sum)
-    case 191:
-      term_number = term_offset = 0;
-      sum = 0;
-      break;
-    // sentence start
-    case '$':
-    case '@':
-      // sentence begin, reset decoding process
-      term_number = term_offset = 0;
-      parity = 0;
-      sum += byte(_c);
-      sentence_type = OTHER;
-      is_checksum_term = false;
-      break;
-    // bitbucket for unwanted trimble and in NMEA unused characters
-    case 20:
-    case 0:
-    case ' ':
-      sum += byte(_c);
-      break;
-    // term terminators, decode term by term
-    case ',':
-      parity ^= _c;
-    case ':':
-    case '*':
-    case '\r':
-    case '\n':
-      sum += byte(_c);
-      term[term_offset] = '\0';
-      // pass completed term off to processing
-      _valid_sentence = parseTerm();
-      // reset parsing state for new term
-      term_number++;
-      term_offset = 0;
-      is_checksum_term = _c == '*';
-      break;
-    // trimble specific term terminator and parity check
-    // ascii 3 is terminator when preceded by ascii 16
-    // last 3 digits before ascii 3 are: number of characters send
-    // 2 byte hex sum of all characters after trimble id 
-    case 3:
-      if (term[term_offset - 1] == 16 && !is_checksum_term) {
-        sum -= byte(term[term_offset - 1]);
-        sum -= byte(term[term_offset - 2]);
-        sum -= byte(term[term_offset - 3]);
-      
-        // check trimble checksum
-        if (sum - byte(term[term_offset - 2]) - (256 * byte(term[term_offset - 3])) == 0) {
-          term[term_offset - 3] = '\0';
-          parseTerm();
-          is_checksum_term = true;
-          _valid_sentence = parseTerm();
-        }
-        term_number++;
-        term_offset = 0;
-        break;
-      }
-      else {
-        // ordinary character
-      }
-    // ordinary characters
-    default:
-      if (term_offset < sizeof (term) - 1)
-        term[term_offset++] = _c;
-      if (!is_checksum_term)
-        parity ^= _c;
-      sum += byte(_c);
-      break;
-    }
+    if (parseByte(_c))
+      _valid_sentence = true;
   }
   return _valid_sentence;
 }
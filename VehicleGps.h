@@ -41,12 +41,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define CAN_SPD_TERM "0CFEE81C"
 #define CAN_XTE_TERM "0CFFFF2A"
 
+// binary framing, u-blox UBX and RTCM 3
+#define UBX_SYNC1          0xB5
+#define UBX_SYNC2          0x62
+#define UBX_NAV_PVT_CLASS  0x01
+#define UBX_NAV_PVT_ID     0x07
+#define UBX_NAV_PVT_LENGTH 92
+#define UBX_VALID_DATE     0x01
+#define UBX_VALID_TIME     0x02
+#define UBX_MAX_LENGTH     1024
+#define RTCM3_PREAMBLE     0xD3
+
 #define GPS_INVALID_FLOAT 999999.9
 #define GPS_INVALID_LONG 0xFFFFFFFF
 
 #define GPS_NO_STATS
 
-#define MINSPEED 0.5f
+#include "VehicleGpsFilter.h"
 
 class VehicleGps {
 private:
@@ -68,6 +79,10 @@ private:
   float course, new_course;
   int xte, new_xte;
   byte quality, new_quality;
+  float accuracy, new_accuracy;
+
+  // smoothed speed and course, moving state
+  VehicleGpsFilter filter;
 
   // timekeepers
   unsigned long last_GGA_fix, new_GGA_fix;
@@ -82,13 +97,32 @@ private:
   byte checksum;
   int sum;
   bool is_checksum_term;
+  bool is_trimble;
+  bool term_error;
   
   // sentence type of decoded message
   enum types{
-    GGA, VTG, XTE, XTE2, CAN_POS, CAN_SPD, CAN_XTE, OTHER
+    GGA, VTG, XTE, XTE2, CAN_POS, CAN_SPD, CAN_XTE, UBX_PVT, OTHER
   };
   types sentence_type;
 
+  // binary frame state variables
+  enum frames{
+    NO_FRAME,
+    UBX_SYNC, UBX_CLASS, UBX_ID, UBX_LENGTH1, UBX_LENGTH2, UBX_PAYLOAD, UBX_CK_A, UBX_CK_B,
+    RTCM_LENGTH1, RTCM_LENGTH2, RTCM_PAYLOAD, RTCM_CRC
+  };
+  frames frame_state;
+  unsigned int frame_length;
+  unsigned int frame_offset;
+  unsigned long frame_value;
+  byte ck_a, ck_b;
+  byte ubx_valid;
+
+  // rtcm correction frames seen on the port
+  unsigned long rtcm_frames;
+  unsigned int rtcm_type;
+
 #ifndef GPS_NO_STATS
   // statistics
   unsigned long encoded_characters;
@@ -105,8 +139,15 @@ private:
   
   bool strcmp(const char *_str1, const char *_str2);
   byte hexToInt(char _c);
+  bool hexToBytes(const char *_c, byte *_out, byte _count);
   
   bool parseTerm();
+  bool parseByte(byte _c);
+  bool parseChar(char _c);
+  bool parseBinary(byte _c);
+  void parseUbxPvt(byte _c);
+  void rtcmCrc(byte _c);
+  void commitSentence();
   
 public:
   // -----------------------------------------------------
@@ -126,8 +167,9 @@ public:
   // ----------------------------------------------------------
   // public inline member functions implemented in VehicleGps.h
   // ----------------------------------------------------------
+  // true while moving, with hysteresis on the smoothed speed
   inline boolean minSpeed(){
-    return GPS_KMH_PER_KNOT * speed > MINSPEED;
+    return filter.isMoving();
   }
 
   inline void readBaudrate(){
@@ -158,6 +200,11 @@ public:
     return datarate;
   }
 
+  // time as hhmmss.cc in last full GPGGA sentence
+  inline float getTime() {
+    return time;
+  }
+
   // date as ddmmyy, time as hhmmsscc, and age in milliseconds
   inline void getDatetime(unsigned long *outdate, unsigned long *outtime) {
     if (outdate) *outdate = date;
@@ -207,11 +254,39 @@ public:
     return speed;
   }
 
-  // xte in last full GPXTE sentence in meters
+  // smoothed course in degrees, held while stationary
+  inline float getFilteredCourse() {
+    return filter.getCourse();
+  }
+
+  // smoothed speed in knots
+  inline float getFilteredSpeed() {
+    return filter.getSpeed();
+  }
+
+  // cross track error in centimeters from the last GPXTE, ROXTE or CAN
+  // XTE sentence. GPXTE carries a magnitude and the direction to steer,
+  // steer L gives a positive and steer R a negative value. ROXTE and CAN
+  // XTE are signed by the receiver and passed through unchanged, check
+  // that their sign agrees with steer L positive before mixing sources
   inline int getXte() {
     return xte;
   }
 
+  // horizontal accuracy estimate in last UBX NAV-PVT message in meters
+  inline float getAccuracy() {
+    return accuracy;
+  }
+
+  // number of RTCM 3 frames passing CRC and message type of the last one
+  inline unsigned long getRtcmFrames() {
+    return rtcm_frames;
+  }
+
+  inline unsigned int getRtcmType() {
+    return rtcm_type;
+  }
+
   //-------------------
   //special conversions
   //-------------------
@@ -231,7 +306,7 @@ public:
     return GPS_KMH_PER_KNOT * speed;
   }
 
-  // cross track error in meters
+  // cross track error in meters, signed as getXte()
   inline float getXteM() {
     return float(xte) / 100;
   }
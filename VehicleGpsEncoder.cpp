@@ -0,0 +1,428 @@
+/*
+  VehicleGpsEncoder - NMEA and CAN sentence generation for VehicleGps.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VehicleGpsEncoder.h"
+
+//------------
+// Constructor
+//------------
+VehicleGpsEncoder::VehicleGpsEncoder(Print &_port){
+  // Transmit ring
+  port = &_port;
+  port_buffered = false;
+  tx_head = 0;
+  tx_tail = 0;
+
+  // Encoder internal variables
+  buffer = 0;
+  size = 0;
+  offset = 0;
+  parity = 0;
+  overflow = false;
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+// -------------------------------------------------------
+// Method for starting a sentence with start char and type
+// -------------------------------------------------------
+void VehicleGpsEncoder::begin(char *_buf, byte _size, char _start, const char *_id) {
+  buffer = _buf;
+  size = _size;
+  offset = 0;
+  parity = 0;
+  overflow = _size == 0;
+
+  // start character is not part of the checksum
+  putRaw(_start);
+  putString(_id);
+}
+
+// ------------------------------------------------------------
+// Method for closing a sentence with checksum and line endings
+// Returns length of the sentence or 0 if the buffer overflowed
+// ------------------------------------------------------------
+byte VehicleGpsEncoder::end() {
+  // parity is final before the asterisk is written
+  byte _parity = parity;
+
+  putRaw('*');
+  putHex(_parity);
+  putRaw('\r');
+  putRaw('\n');
+
+  if (overflow)
+    return 0;
+
+  buffer[offset] = '\0';
+  return offset;
+}
+
+// --------------------------------------------------------
+// Method for writing a character outside of the checksum
+// --------------------------------------------------------
+void VehicleGpsEncoder::putRaw(char _c) {
+  // keep room for the null character
+  if (offset + 1 < size)
+    buffer[offset++] = _c;
+  else
+    overflow = true;
+}
+
+// --------------------------------------------------------
+// Method for writing a character and adding it to checksum
+// --------------------------------------------------------
+void VehicleGpsEncoder::put(char _c) {
+  parity ^= _c;
+  putRaw(_c);
+}
+
+void VehicleGpsEncoder::putString(const char *_str) {
+  while (*_str)
+    put(*_str++);
+}
+
+// ----------------------------------------------------------------
+// Method for writing an unsigned integer with minimal digit count
+// ----------------------------------------------------------------
+void VehicleGpsEncoder::putUnsigned(unsigned long _value, byte _digits) {
+  char _tmp[10];
+  byte _n = 0;
+
+  // digits are produced least significant first
+  do {
+    _tmp[_n++] = '0' + _value % 10;
+    _value /= 10;
+  } while (_value && _n < sizeof (_tmp));
+
+  while (_n < _digits && _n < sizeof (_tmp))
+    _tmp[_n++] = '0';
+
+  while (_n)
+    put(_tmp[--_n]);
+}
+
+// ---------------------------------------------------------------
+// Method for writing a scaled integer as decimal, 1234/2 -> 12.34
+// ---------------------------------------------------------------
+void VehicleGpsEncoder::putFixed(long _value, byte _decimals) {
+  unsigned long _scale = 1;
+  unsigned long _abs;
+
+  for (byte i = 0; i < _decimals; i++)
+    _scale *= 10;
+
+  if (_value < 0) {
+    put('-');
+    _abs = -_value;
+  }
+  else {
+    _abs = _value;
+  }
+
+  putUnsigned(_abs / _scale, 1);
+  if (_decimals) {
+    put('.');
+    putUnsigned(_abs % _scale, _decimals);
+  }
+}
+
+// -----------------------------------------------------
+// Method for writing float degrees as ascii deg/min.dec
+// -----------------------------------------------------
+void VehicleGpsEncoder::putDegrees(float _degrees, byte _digits) {
+  if (_degrees < 0)
+    _degrees = -_degrees;
+
+  // split first, float has no room for degrees and 1e-5 minutes together
+  unsigned long _left = _degrees;
+  unsigned long _right = toFixed((_degrees - _left) * 60, 100000);
+
+  if (_right >= 6000000) {
+    _right -= 6000000;
+    _left++;
+  }
+
+  putUnsigned(_left, _digits);
+  putUnsigned(_right / 100000, 2);
+  put('.');
+  putUnsigned(_right % 100000, 5);
+}
+
+// ---------------------------------------
+// Method for writing a byte as 2 hex chars
+// ---------------------------------------
+void VehicleGpsEncoder::putHex(byte _value) {
+  static const char _hex[] = "0123456789ABCDEF";
+
+  put(_hex[_value >> 4]);
+  put(_hex[_value & 0x0F]);
+}
+
+// -------------------------------------------------------------------
+// Method for writing CAN data bytes, least significant byte first as
+// expected by the CAN decoders in VehicleGps::parseTerm()
+// -------------------------------------------------------------------
+void VehicleGpsEncoder::putLittleEndian(unsigned long _value, byte _bytes) {
+  while (_bytes--) {
+    putHex(_value & 0xFF);
+    _value >>= 8;
+  }
+}
+
+// --------------------------------------------------
+// Method for rounding a float to a scaled long value
+// --------------------------------------------------
+long VehicleGpsEncoder::toFixed(float _f, long _scale) {
+  _f *= _scale;
+  return _f < 0 ? long(_f - 0.5) : long(_f + 0.5);
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+// ----------------------------------------------------
+// Method for encoding position and quality as GPGGA
+// $GPGGA,hhmmss.ss,ddmm.mmmmm,N,dddmm.mmmmm,E,q,,,a.a,M,,M,,*cs
+// ----------------------------------------------------
+byte VehicleGpsEncoder::encodeGga(VehicleGps &_gps, char *_buf, byte _size) {
+  float _time = _gps.getTime();
+  float _lat, _lon;
+  float _alt = _gps.getAltitude();
+
+  _gps.getPosition(&_lat, &_lon);
+
+  begin(_buf, _size, '$', GPGGA_TERM);
+
+  put(',');
+  if (valid(_time)) {
+    long _cs = toFixed(_time, 100);
+    putUnsigned(_cs / 100, 6);
+    put('.');
+    putUnsigned(_cs % 100, 2);
+  }
+
+  put(',');
+  if (valid(_lat)) {
+    putDegrees(_lat, 2);
+    put(',');
+    put(_lat < 0 ? 'S' : 'N');
+  }
+  else {
+    put(',');
+  }
+
+  put(',');
+  if (valid(_lon)) {
+    putDegrees(_lon, 3);
+    put(',');
+    put(_lon < 0 ? 'W' : 'E');
+  }
+  else {
+    put(',');
+  }
+
+  put(',');
+  putUnsigned(_gps.getQuality(), 1);
+
+  // satellites and hdop are not decoded
+  putString(",,,");
+  if (valid(_alt))
+    putFixed(toFixed(_alt, 10), 1);
+  putString(",M,,M,,");
+
+  return end();
+}
+
+// ----------------------------------------------
+// Method for encoding course and speed as GPVTG
+// $GPVTG,c.c,T,,M,s.ss,N,k.kk,K*cs
+// ----------------------------------------------
+byte VehicleGpsEncoder::encodeVtg(VehicleGps &_gps, char *_buf, byte _size) {
+  float _course = _gps.getCourse();
+  float _speed = _gps.getSpeed();
+
+  begin(_buf, _size, '$', GPVTG_TERM);
+
+  put(',');
+  if (valid(_course))
+    putFixed(toFixed(_course, 10), 1);
+  putString(",T,,M,");
+
+  if (valid(_speed)) {
+    putFixed(toFixed(_speed, 100), 2);
+    putString(",N,");
+    putFixed(toFixed(_gps.getSpeedKmh(), 100), 2);
+    putString(",K");
+  }
+  else {
+    putString(",N,,K");
+  }
+
+  return end();
+}
+
+// --------------------------------------------------------------
+// Method for encoding cross track error in meters as GPXTE, the
+// direction field tells which way to steer to get back on track,
+// L for positive and R for negative xte as decoded by parseTerm()
+// $GPXTE,A,A,x.xx,L,M*cs
+// --------------------------------------------------------------
+byte VehicleGpsEncoder::encodeXte(VehicleGps &_gps, char *_buf, byte _size) {
+  int _xte = _gps.getXte();
+
+  begin(_buf, _size, '$', GPXTE_TERM);
+
+  putString(",A,A,");
+  putFixed(_xte < 0 ? -long(_xte) : long(_xte), 2);
+  put(',');
+  put(_xte < 0 ? 'R' : 'L');
+  putString(",M");
+
+  return end();
+}
+
+// -----------------------------------------------------------------
+// Method for encoding position as CAN frame, 1e-7 degrees + offset
+// @0CFEF31C:llllllllLLLLLLLL*cs
+// -----------------------------------------------------------------
+byte VehicleGpsEncoder::encodeCanPos(VehicleGps &_gps, char *_buf, byte _size) {
+  float _lat, _lon;
+
+  _gps.getPosition(&_lat, &_lon);
+
+  // there is no "not available" value for a position
+  if (!valid(_lat) || !valid(_lon))
+    return 0;
+
+  begin(_buf, _size, '@', CAN_POS_TERM);
+
+  // term separator is not part of the checksum in update()
+  putRaw(':');
+  // offset in unsigned arithmetic, the sum does not fit a signed long
+  putLittleEndian((unsigned long)toFixed(_lat, 10000000) + 2100000000UL, 4);
+  putLittleEndian((unsigned long)toFixed(_lon, 10000000) + 2100000000UL, 4);
+
+  return end();
+}
+
+// ----------------------------------------------------------------
+// Method for encoding course, speed and altitude as CAN frame,
+// invalid values are sent as FFFF (not available) and skipped by the decoder
+// @0CFEE81C:ccccssssFFFFaaaa*cs
+// ----------------------------------------------------------------
+byte VehicleGpsEncoder::encodeCanSpd(VehicleGps &_gps, char *_buf, byte _size) {
+  float _course = _gps.getCourse();
+  float _speed = _gps.getSpeed();
+  float _alt = _gps.getAltitude();
+
+  begin(_buf, _size, '@', CAN_SPD_TERM);
+
+  putRaw(':');
+  putLittleEndian(valid(_course) ? word(toFixed(_course, 128)) : 0xFFFF, 2);
+  putLittleEndian(valid(_speed) ? word(toFixed(_speed, 256)) : 0xFFFF, 2);
+  putLittleEndian(0xFFFF, 2);
+  putLittleEndian(valid(_alt) ? word(toFixed(_alt + 2500, 8)) : 0xFFFF, 2);
+
+  return end();
+}
+
+// ----------------------------------------------------------------
+// Method for encoding cross track error and RTK state as CAN frame
+// @0CFFFF2A:FFqqFFxxxxFFFFFF*cs
+// ----------------------------------------------------------------
+byte VehicleGpsEncoder::encodeCanXte(VehicleGps &_gps, char *_buf, byte _size) {
+  begin(_buf, _size, '@', CAN_XTE_TERM);
+
+  putRaw(':');
+  putHex(0xFF);
+  putHex(_gps.getQuality() == 4 ? 0x10 : 0x00);
+  putHex(0xFF);
+  putLittleEndian(word(long(_gps.getXte()) * 2 + 32000), 2);
+  putLittleEndian(0xFFFFFF, 3);
+
+  return end();
+}
+
+// ----------------------------------------------------------
+// Method for queueing a complete sentence in transmit ring
+// Returns false, and queues nothing, if there is not enough room
+// ----------------------------------------------------------
+bool VehicleGpsEncoder::send(const char *_buf, byte _length) {
+  if (_length == 0 || _length > txFree())
+    return false;
+
+  for (byte i = 0; i < _length; i++) {
+    tx_buffer[tx_head] = _buf[i];
+    tx_head = (tx_head + 1) & GPS_TX_BUFFER_MASK;
+  }
+  return true;
+}
+
+bool VehicleGpsEncoder::sendGga(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeGga(_gps, _buf, sizeof (_buf)));
+}
+
+bool VehicleGpsEncoder::sendVtg(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeVtg(_gps, _buf, sizeof (_buf)));
+}
+
+bool VehicleGpsEncoder::sendXte(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeXte(_gps, _buf, sizeof (_buf)));
+}
+
+bool VehicleGpsEncoder::sendCanPos(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeCanPos(_gps, _buf, sizeof (_buf)));
+}
+
+bool VehicleGpsEncoder::sendCanSpd(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeCanSpd(_gps, _buf, sizeof (_buf)));
+}
+
+bool VehicleGpsEncoder::sendCanXte(VehicleGps &_gps) {
+  char _buf[GPS_MAX_SENTENCE];
+  return send(_buf, encodeCanXte(_gps, _buf, sizeof (_buf)));
+}
+
+// ------------------------------------------------------------------
+// Method for moving queued characters to the port, only as many as
+// the hardware buffer accepts so the main loop is never blocked
+// ------------------------------------------------------------------
+void VehicleGpsEncoder::transmit() {
+  int _room = port->availableForWrite();
+
+  // the Print default returns 0, a buffered port reports room when idle
+  if (_room > 0)
+    port_buffered = true;
+  else if (!port_buffered)
+    _room = GPS_TX_UNBUFFERED;
+
+  while (_room-- > 0 && tx_tail != tx_head) {
+    port->write(tx_buffer[tx_tail]);
+    tx_tail = (tx_tail + 1) & GPS_TX_BUFFER_MASK;
+  }
+}
@@ -0,0 +1,126 @@
+/*
+  VehicleGpsEncoder - NMEA and CAN sentence generation for VehicleGps.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VehicleGpsEncoder_h
+#define VehicleGpsEncoder_h
+
+#include <Arduino.h>
+#include "VehicleGps.h"
+
+// size of the transmit ring, must be a power of two and at most 256
+#define GPS_TX_BUFFER_SIZE 128
+#define GPS_TX_BUFFER_MASK (GPS_TX_BUFFER_SIZE - 1)
+
+// longest NMEA sentence including "\r\n" and terminating null character
+#define GPS_MAX_SENTENCE 83
+
+// characters written per transmit() to ports whose availableForWrite()
+// never reports room, like SoftwareSerial, each one blocks for its own
+// transmission time
+#define GPS_TX_UNBUFFERED 4
+
+class VehicleGpsEncoder {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  // output port and transmit ring, any Print, see transmit()
+  Print *port;
+  bool port_buffered;
+  char tx_buffer[GPS_TX_BUFFER_SIZE];
+  byte tx_head;
+  byte tx_tail;
+
+  // encoding state variables
+  char *buffer;
+  byte size;
+  byte offset;
+  byte parity;
+  bool overflow;
+
+  //--------------------------------------------------------------
+  // private member functions implemented in VehicleGpsEncoder.cpp
+  //--------------------------------------------------------------
+  void begin(char *_buf, byte _size, char _start, const char *_id);
+  byte end();
+
+  void putRaw(char _c);
+  void put(char _c);
+  void putString(const char *_str);
+  void putUnsigned(unsigned long _value, byte _digits);
+  void putFixed(long _value, byte _decimals);
+  void putDegrees(float _degrees, byte _digits);
+  void putHex(byte _value);
+  void putLittleEndian(unsigned long _value, byte _bytes);
+
+  static long toFixed(float _f, long _scale);
+
+  // ----------------------------------------------------------
+  // private inline member functions implemented in this header
+  // ----------------------------------------------------------
+  inline static bool valid(float _f) {
+    return _f != float(GPS_INVALID_FLOAT);
+  }
+
+public:
+  // ------------------------------------------------------------
+  // public member functions implemented in VehicleGpsEncoder.cpp
+  // ------------------------------------------------------------
+
+  //Constructor
+  VehicleGpsEncoder(Print &_port);
+
+  // encode last fix into caller buffer, returns length or 0 if it does not fit
+  byte encodeGga(VehicleGps &_gps, char *_buf, byte _size);
+  byte encodeVtg(VehicleGps &_gps, char *_buf, byte _size);
+  byte encodeXte(VehicleGps &_gps, char *_buf, byte _size);
+  byte encodeCanPos(VehicleGps &_gps, char *_buf, byte _size);
+  byte encodeCanSpd(VehicleGps &_gps, char *_buf, byte _size);
+  byte encodeCanXte(VehicleGps &_gps, char *_buf, byte _size);
+
+  // queue sentences in the transmit ring, returns false if there is no room
+  bool send(const char *_buf, byte _length);
+  bool sendGga(VehicleGps &_gps);
+  bool sendVtg(VehicleGps &_gps);
+  bool sendXte(VehicleGps &_gps);
+  bool sendCanPos(VehicleGps &_gps);
+  bool sendCanSpd(VehicleGps &_gps);
+  bool sendCanXte(VehicleGps &_gps);
+
+  // move queued characters to the port, call from loop(), does not block
+  // once the port reported room through availableForWrite(), ports that
+  // never do get GPS_TX_UNBUFFERED blocking characters per call
+  void transmit();
+
+  // ----------------------------------------------------------
+  // public inline member functions implemented in this header
+  // ----------------------------------------------------------
+
+  // free space in transmit ring
+  inline byte txFree() {
+    return (tx_tail - tx_head - 1) & GPS_TX_BUFFER_MASK;
+  }
+
+  // characters waiting in transmit ring
+  inline byte txPending() {
+    return (tx_head - tx_tail) & GPS_TX_BUFFER_MASK;
+  }
+};
+#endif
@@ -0,0 +1,242 @@
+/*
+  VehicleGpsFilter - speed and course smoothing for VehicleGps.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VehicleGps.h"
+
+// meters per degree latitude, same sphere as VehicleGps::distanceBetween
+#define GPS_METERS_PER_DEGREE 111226.26
+
+//------------
+// Constructor
+//------------
+VehicleGpsFilter::VehicleGpsFilter(){
+  reset();
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+#if !GPS_FILTER_WINDOW
+// ------------------------------------------------------------
+// Method for the weight of a new fix _dt ms after the previous one
+// ------------------------------------------------------------
+float VehicleGpsFilter::weight(unsigned long _dt) {
+  return 1 - exp(-float(_dt) / GPS_FILTER_TAU);
+}
+#endif
+
+// ------------------------------------------------------------
+// Method for smoothing speed and updating the moving state, a
+// fix that may be noise only can stop the vehicle when !_start
+// ------------------------------------------------------------
+void VehicleGpsFilter::filterSpeed(float _speed, unsigned long _time, bool _start) {
+#if GPS_FILTER_WINDOW
+  speeds[speed_index] = _speed;
+  speed_times[speed_index] = _time;
+  speed_index = (speed_index + 1) % GPS_FILTER_WINDOW;
+  if (speed_count < GPS_FILTER_WINDOW)
+    speed_count++;
+
+  // newest samples sit just before speed_index, older ones have expired
+  float _sum = 0;
+  byte _count = 0;
+  for (byte i = 0; i < speed_count; i++) {
+    byte _j = (speed_index + GPS_FILTER_WINDOW - 1 - i) % GPS_FILTER_WINDOW;
+    if (_time - speed_times[_j] > GPS_FILTER_AGE)
+      break;
+    _sum += speeds[_j];
+    _count++;
+  }
+  speed = _sum / _count;
+#else
+  speed = has_speed ? speed + weight(_time - speed_time) * (_speed - speed) : _speed;
+  speed_time = _time;
+#endif
+  has_speed = true;
+
+  // separate thresholds so noise around one value does not toggle the state
+  float _kmh = GPS_KMH_PER_KNOT * speed;
+  if (moving) {
+    if (_kmh < GPS_STATIONARY_KMH)
+      moving = false;
+  }
+  else if (_start && _kmh > GPS_MOVING_KMH) {
+    moving = true;
+    // start over, the vehicle may pull away in another direction
+#if GPS_FILTER_WINDOW
+    course_count = 0;
+#else
+    has_course = false;
+#endif
+  }
+}
+
+// --------------------------------------------------------------
+// Method for smoothing course as a unit vector, only while moving
+// --------------------------------------------------------------
+void VehicleGpsFilter::filterCourse(float _course, unsigned long _time) {
+  float _rad = radians(_course);
+  float _sine = sin(_rad);
+  float _cosine = cos(_rad);
+
+#if GPS_FILTER_WINDOW
+  sines[course_index] = _sine;
+  cosines[course_index] = _cosine;
+  course_times[course_index] = _time;
+  course_index = (course_index + 1) % GPS_FILTER_WINDOW;
+  if (course_count < GPS_FILTER_WINDOW)
+    course_count++;
+
+  _sine = _cosine = 0;
+  for (byte i = 0; i < course_count; i++) {
+    // newest samples sit just before course_index, older ones have expired
+    byte _j = (course_index + GPS_FILTER_WINDOW - 1 - i) % GPS_FILTER_WINDOW;
+    if (_time - course_times[_j] > GPS_FILTER_AGE)
+      break;
+    _sine += sines[_j];
+    _cosine += cosines[_j];
+  }
+#else
+  if (has_course) {
+    float _weight = weight(_time - course_time);
+    sine += _weight * (_sine - sine);
+    cosine += _weight * (_cosine - cosine);
+  }
+  else {
+    sine = _sine;
+    cosine = _cosine;
+  }
+  course_time = _time;
+  _sine = sine;
+  _cosine = cosine;
+#endif
+
+  // a tiny negative angle rounds to 360 after the add
+  course = degrees(atan2(_sine, _cosine));
+  if (course < 0)
+    course += 360;
+  if (course >= 360)
+    course -= 360;
+  has_course = true;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void VehicleGpsFilter::reset() {
+  speed = 0;
+  course = 0;
+  moving = false;
+  has_speed = false;
+  has_course = false;
+
+#if GPS_FILTER_WINDOW
+  speed_index = speed_count = 0;
+  course_index = course_count = 0;
+#else
+  sine = 0;
+  cosine = 1;
+  speed_time = course_time = 0;
+#endif
+
+  last_latitude = 0;
+  last_longitude = 0;
+  step_north = 0;
+  step_east = 0;
+  last_position_time = 0;
+  last_velocity_time = 0;
+  has_position = false;
+  has_step = false;
+  has_velocity = false;
+}
+
+// ---------------------------------------------------
+// Method for adding a speed and course fix
+// ---------------------------------------------------
+void VehicleGpsFilter::addVelocity(float _speed, float _course, unsigned long _time) {
+  // leave an invalid fix to the positions
+  if (_speed == float(GPS_INVALID_FLOAT))
+    return;
+
+  last_velocity_time = _time;
+  has_velocity = true;
+  // position steps start over once the fixes stop
+  has_step = false;
+
+  filterSpeed(_speed, _time, true);
+
+  // a course measured at walking pace is mostly noise
+  if (moving && GPS_KMH_PER_KNOT * _speed > GPS_MOVING_KMH &&
+      _course != float(GPS_INVALID_FLOAT))
+    filterCourse(_course, _time);
+}
+
+// -----------------------------------------------------------------
+// Method for adding a position fix, speed and course are derived
+// from the travel since the previous position while no speed and
+// course fixes arrive, short steps are accumulated to beat the noise
+// -----------------------------------------------------------------
+void VehicleGpsFilter::addPosition(float _lat, float _lon, unsigned long _time) {
+  unsigned long _dt = _time - last_position_time;
+
+  if (has_position && !(has_velocity && _time - last_velocity_time < GPS_VELOCITY_TIMEOUT)) {
+    // flat earth is plenty over a few meters
+    float _north = (_lat - last_latitude) * float(GPS_METERS_PER_DEGREE);
+    float _east = (_lon - last_longitude) * float(GPS_METERS_PER_DEGREE) * cos(radians(_lat));
+    float _distance = sqrt(_north * _north + _east * _east);
+
+    // keep the previous position until the vehicle has moved far enough,
+    // or long enough when crawling or standing still
+    if (_dt < GPS_COURSE_TIME ||
+        (_distance < GPS_COURSE_DISTANCE && _dt < GPS_VELOCITY_TIMEOUT))
+      return;
+
+    // velocity over this step and change since the previous step in m/s
+    float _north_speed = _north * 1000 / _dt;
+    float _east_speed = _east * 1000 / _dt;
+    float _dn = _north_speed - step_north;
+    float _de = _east_speed - step_east;
+    float _speed = _distance * 1000 / _dt;
+
+    // a jump is rejected on the way out and on the way back, a real change
+    // of speed is accepted from the next step on
+    bool _plausible = _speed * 3.6f <= GPS_MAX_KMH &&
+      (!has_step || sqrt(_dn * _dn + _de * _de) * 1000 / _dt <= GPS_MAX_ACCELERATION);
+
+    step_north = _north_speed;
+    step_east = _east_speed;
+    has_step = true;
+
+    if (_plausible) {
+      // creeping less than GPS_COURSE_DISTANCE is not told apart from noise
+      filterSpeed(_speed / GPS_MS_PER_KNOT, _time, _distance >= GPS_COURSE_DISTANCE);
+      if (moving && _distance >= GPS_COURSE_DISTANCE && _speed * 3.6f > GPS_MOVING_KMH) {
+        float _course = degrees(atan2(_east, _north));
+        filterCourse(_course < 0 ? _course + 360 : _course, _time);
+      }
+    }
+  }
+
+  last_latitude = _lat;
+  last_longitude = _lon;
+  last_position_time = _time;
+  has_position = true;
+}
@@ -0,0 +1,129 @@
+/*
+  VehicleGpsFilter - speed and course smoothing for VehicleGps.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VehicleGpsFilter_h
+#define VehicleGpsFilter_h
+
+// included by VehicleGps.h after its constants are defined
+#include <Arduino.h>
+
+// smoothing, edit these here, the filter is part of the VehicleGps layout
+// moving average over the last GPS_FILTER_WINDOW fixes no older than
+// GPS_FILTER_AGE ms when not 0, exponential with time constant
+// GPS_FILTER_TAU ms otherwise, so the response does not depend on the
+// rate at which fixes arrive
+#define GPS_FILTER_WINDOW 0
+#define GPS_FILTER_AGE    2000
+#define GPS_FILTER_TAU    500
+
+// moving/stationary hysteresis in km/h
+#define GPS_MOVING_KMH     0.5f
+#define GPS_STATIONARY_KMH 0.3f
+
+// course from positions when no speed/course fix arrived for this long
+#define GPS_VELOCITY_TIMEOUT 2000
+// minimum travel in meters and time in ms between positions for a course
+#define GPS_COURSE_DISTANCE  1.0f
+#define GPS_COURSE_TIME      1000
+
+// position steps implying more than this are rejected as jumps
+#define GPS_MAX_KMH          100.0f
+#define GPS_MAX_ACCELERATION 3.0f   // m/s2
+
+class VehicleGpsFilter {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  // smoothed output
+  float speed;
+  float course;
+  bool moving;
+  bool has_speed;
+  bool has_course;
+
+  // filter state, course is averaged as a unit vector to survive 0/360
+#if GPS_FILTER_WINDOW
+  float speeds[GPS_FILTER_WINDOW];
+  float sines[GPS_FILTER_WINDOW];
+  float cosines[GPS_FILTER_WINDOW];
+  unsigned long speed_times[GPS_FILTER_WINDOW];
+  unsigned long course_times[GPS_FILTER_WINDOW];
+  byte speed_index, speed_count;
+  byte course_index, course_count;
+#else
+  float sine, cosine;
+  unsigned long speed_time, course_time;
+#endif
+
+  // previous position and step velocity in m/s for derived speed and course
+  float last_latitude, last_longitude;
+  float step_north, step_east;
+  unsigned long last_position_time;
+  unsigned long last_velocity_time;
+  bool has_position;
+  bool has_step;
+  bool has_velocity;
+
+  //-------------------------------------------------------------
+  // private member functions implemented in VehicleGpsFilter.cpp
+  //-------------------------------------------------------------
+  void filterSpeed(float _speed, unsigned long _time, bool _start);
+  void filterCourse(float _course, unsigned long _time);
+
+#if !GPS_FILTER_WINDOW
+  static float weight(unsigned long _dt);
+#endif
+
+public:
+  // -----------------------------------------------------------
+  // public member functions implemented in VehicleGpsFilter.cpp
+  // -----------------------------------------------------------
+
+  //Constructor
+  VehicleGpsFilter();
+
+  void reset();
+
+  // speed in knots and course in degrees from VTG, CAN or UBX
+  void addVelocity(float _speed, float _course, unsigned long _time);
+
+  // position in degrees from GGA, CAN or UBX
+  void addPosition(float _lat, float _lon, unsigned long _time);
+
+  // ----------------------------------------------------------
+  // public inline member functions implemented in this header
+  // ----------------------------------------------------------
+
+  // smoothed speed in knots
+  inline float getSpeed() {
+    return has_speed ? speed : GPS_INVALID_FLOAT;
+  }
+
+  // smoothed course in degrees, held while stationary
+  inline float getCourse() {
+    return has_course ? course : GPS_INVALID_FLOAT;
+  }
+
+  inline bool isMoving() {
+    return moving;
+  }
+};
+#endif
@@ -0,0 +1,396 @@
+/*
+  VehicleGpsGeofence - field boundary and no-spray zone containment.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VehicleGpsGeofence.h"
+
+//------------
+// Constructor
+//------------
+VehicleGpsGeofence::VehicleGpsGeofence(){
+  hysteresis = long(GEOFENCE_HYSTERESIS * GEOFENCE_DM_PER_METER);
+  clear();
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+// ---------------------------------------------------------------
+// Method for projecting degrees onto the local frame in decimeters
+// ---------------------------------------------------------------
+void VehicleGpsGeofence::toLocal(float _lat, float _lon, long *_x, long *_y) {
+  // subtract first, float has no room for the absolute position in dm
+  *_x = long((_lon - origin_longitude) * dm_per_degree_longitude);
+  *_y = long((_lat - origin_latitude) * float(GEOFENCE_DM_PER_DEGREE));
+}
+
+// ------------------------------------------------------------------
+// Method for point in polygon test, only the edges in the band of
+// the point can cross its horizontal ray
+// ------------------------------------------------------------------
+bool VehicleGpsGeofence::containsLocal(const polygon &_p, long _x, long _y) {
+  long _lx = _x - _p.x;
+  long _ly = _y - _p.y;
+
+  // bounding box
+  if (_lx < 0 || _ly < 0 || _lx > _p.width || _ly > _p.height)
+    return false;
+
+  byte _band = _ly / _p.band_height;
+  bool _inside = false;
+
+  const unsigned int *_start = band_start + _p.first_band;
+
+  for (unsigned int i = _start[_band]; i < _start[_band + 1]; i++) {
+    byte _e = band_edges[i];
+    unsigned int _a = _p.first_vertex + _e;
+    unsigned int _b = _p.first_vertex + (_e + 1 == _p.vertex_count ? 0 : _e + 1);
+    long _y1 = vertex_y[_a];
+    long _y2 = vertex_y[_b];
+
+    if ((_y1 > _ly) != (_y2 > _ly)) {
+      // compare against the crossing without dividing
+      long _lhs = (_lx - vertex_x[_a]) * (_y2 - _y1);
+      long _rhs = (_ly - _y1) * (long(vertex_x[_b]) - vertex_x[_a]);
+      if (_y2 > _y1 ? _lhs < _rhs : _lhs > _rhs)
+        _inside = !_inside;
+    }
+  }
+  return _inside;
+}
+
+// ------------------------------------------------------------------
+// Method for distance to the nearest edge in decimeters, bands are
+// visited nearest first until no band can hold a closer edge
+// Returns as soon as a distance below _limit is found
+// ------------------------------------------------------------------
+long VehicleGpsGeofence::distanceLocal(const polygon &_p, long _x, long _y, long _limit) {
+  long _lx = _x - _p.x;
+  long _ly = _y - _p.y;
+  long _best = 0x7FFFFFFF;
+  const unsigned int *_start = band_start + _p.first_band;
+
+  int _band = _ly < 0 ? 0 : _ly / _p.band_height;
+  if (_band >= _p.bands)
+    _band = _p.bands - 1;
+
+  for (int _step = 0; _step < _p.bands; _step++) {
+    bool _closer = false;
+
+    for (int _side = -1; _side <= 1; _side += 2) {
+      int _k = _band + _side * _step;
+      if (_k < 0 || _k >= _p.bands || (_step == 0 && _side > 0))
+        continue;
+
+      // vertical gap between point and band
+      long _bottom = long(_k) * _p.band_height;
+      long _top = _bottom + _p.band_height;
+      long _gap = _ly < _bottom ? _bottom - _ly : (_ly > _top ? _ly - _top : 0);
+      if (_gap >= _best)
+        continue;
+      _closer = true;
+
+      for (unsigned int i = _start[_k]; i < _start[_k + 1]; i++) {
+        byte _e = band_edges[i];
+        unsigned int _a = _p.first_vertex + _e;
+        unsigned int _b = _p.first_vertex + (_e + 1 == _p.vertex_count ? 0 : _e + 1);
+        long _d = distanceToSegment(_lx, _ly, vertex_x[_a], vertex_y[_a], vertex_x[_b], vertex_y[_b]);
+        if (_d < _best)
+          _best = _d;
+      }
+      if (_best < _limit)
+        return _best;
+    }
+    // all remaining bands are further away than the best edge
+    if (!_closer)
+      break;
+  }
+  return _best;
+}
+
+// -------------------------------------------------------
+// Method for distance from a point to a segment, local dm
+// -------------------------------------------------------
+long VehicleGpsGeofence::distanceToSegment(long _x, long _y, int _x1, int _y1, int _x2, int _y2) {
+  float _dx = float(_x2) - _x1;
+  float _dy = float(_y2) - _y1;
+  float _px = float(_x) - _x1;
+  float _py = float(_y) - _y1;
+  float _length = _dx * _dx + _dy * _dy;
+  float _t = _length > 0 ? (_px * _dx + _py * _dy) / _length : 0;
+
+  // clamp to the segment end points
+  if (_t < 0)
+    _t = 0;
+  else if (_t > 1)
+    _t = 1;
+
+  _px -= _t * _dx;
+  _py -= _t * _dy;
+  return long(sqrt(_px * _px + _py * _py));
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+// --------------------------------------------------------------
+// Method for setting the local frame origin, only while no
+// vertices are stored as they are kept relative to this origin
+// --------------------------------------------------------------
+bool VehicleGpsGeofence::setOrigin(float _lat, float _lon) {
+  if (vertex_count)
+    return false;
+
+  origin_latitude = _lat;
+  origin_longitude = _lon;
+  dm_per_degree_longitude = float(GEOFENCE_DM_PER_DEGREE) * cos(_lat * 0.017453292519943295);
+  has_origin = true;
+  return true;
+}
+
+void VehicleGpsGeofence::setHysteresis(float _meters) {
+  hysteresis = long(_meters * GEOFENCE_DM_PER_METER);
+}
+
+void VehicleGpsGeofence::clear() {
+  polygon_count = 0;
+  vertex_count = 0;
+  band_count = 0;
+  band_edge_count = 0;
+  origin_latitude = 0;
+  origin_longitude = 0;
+  dm_per_degree_longitude = float(GEOFENCE_DM_PER_DEGREE);
+  has_origin = false;
+  is_building = false;
+  first_x = 0;
+  first_y = 0;
+}
+
+// ---------------------------------------
+// Method for starting a new polygon
+// Returns false if all polygons are in use
+// ---------------------------------------
+bool VehicleGpsGeofence::beginPolygon() {
+  if (is_building || polygon_count >= GEOFENCE_MAX_POLYGONS)
+    return false;
+
+  polygon &_p = polygons[polygon_count];
+  _p.first_vertex = vertex_count;
+  _p.vertex_count = 0;
+  _p.state = 0;
+  is_building = true;
+  return true;
+}
+
+// ------------------------------------------------------------------
+// Method for adding a vertex to the polygon under construction
+// Returns false if the pool is full or the polygon grows too large
+// ------------------------------------------------------------------
+bool VehicleGpsGeofence::addVertex(float _lat, float _lon) {
+  if (!is_building)
+    return false;
+
+  polygon &_p = polygons[polygon_count];
+  if (vertex_count >= GEOFENCE_MAX_VERTICES || _p.vertex_count == 255)
+    return false;
+
+  if (!has_origin)
+    setOrigin(_lat, _lon);
+
+  long _x, _y;
+  toLocal(_lat, _lon, &_x, &_y);
+
+  // vertices are kept relative to the first one until endPolygon()
+  if (_p.vertex_count == 0) {
+    first_x = _x;
+    first_y = _y;
+  }
+  _x -= first_x;
+  _y -= first_y;
+  if (_x < -GEOFENCE_MAX_SIZE || _x > GEOFENCE_MAX_SIZE ||
+      _y < -GEOFENCE_MAX_SIZE || _y > GEOFENCE_MAX_SIZE)
+    return false;
+
+  vertex_x[vertex_count] = _x;
+  vertex_y[vertex_count] = _y;
+  vertex_count++;
+  _p.vertex_count++;
+  return true;
+}
+
+// ------------------------------------------------------------------
+// Method for closing the polygon, moves the vertices onto the lower
+// left corner of the bounding box and builds the band index
+// Returns false, and drops the polygon, if it can not be stored
+// ------------------------------------------------------------------
+bool VehicleGpsGeofence::endPolygon() {
+  if (!is_building)
+    return false;
+  is_building = false;
+
+  polygon &_p = polygons[polygon_count];
+  unsigned int _first = _p.first_vertex;
+  byte _n = _p.vertex_count;
+
+  if (_n < 3) {
+    vertex_count = _first;
+    return false;
+  }
+
+  // bounding box
+  long _min_x = vertex_x[_first], _max_x = _min_x;
+  long _min_y = vertex_y[_first], _max_y = _min_y;
+  for (unsigned int i = _first + 1; i < _first + _n; i++) {
+    if (vertex_x[i] < _min_x) _min_x = vertex_x[i];
+    if (vertex_x[i] > _max_x) _max_x = vertex_x[i];
+    if (vertex_y[i] < _min_y) _min_y = vertex_y[i];
+    if (vertex_y[i] > _max_y) _max_y = vertex_y[i];
+  }
+  if (_max_x - _min_x > GEOFENCE_MAX_SIZE || _max_y - _min_y > GEOFENCE_MAX_SIZE) {
+    vertex_count = _first;
+    return false;
+  }
+
+  for (unsigned int i = _first; i < _first + _n; i++) {
+    vertex_x[i] -= _min_x;
+    vertex_y[i] -= _min_y;
+  }
+  _p.x = first_x + _min_x;
+  _p.y = first_y + _min_y;
+  _p.width = _max_x - _min_x;
+  _p.height = _max_y - _min_y;
+
+  // bands scale with the vertex count, limited by the free band pool
+  if (band_count + 2 > GEOFENCE_MAX_BANDS) {
+    vertex_count = _first;
+    return false;
+  }
+  unsigned int _bands = _n / GEOFENCE_EDGES_PER_BAND;
+  if (_bands > GEOFENCE_MAX_BANDS - band_count - 1)
+    _bands = GEOFENCE_MAX_BANDS - band_count - 1;
+  if (_bands < 1)
+    _bands = 1;
+  _p.bands = _bands;
+  _p.first_band = band_count;
+  _p.band_height = _p.height / _p.bands + 1;
+
+  // every edge is listed in each band its y range overlaps
+  unsigned int _start = band_edge_count;
+  for (byte _k = 0; _k < _p.bands; _k++) {
+    long _bottom = long(_k) * _p.band_height;
+    long _top = _bottom + _p.band_height;
+
+    band_start[band_count++] = band_edge_count;
+    for (byte _e = 0; _e < _n; _e++) {
+      int _y1 = vertex_y[_first + _e];
+      int _y2 = vertex_y[_first + (_e + 1 == _n ? 0 : _e + 1)];
+      int _low = _y1 < _y2 ? _y1 : _y2;
+      int _high = _y1 < _y2 ? _y2 : _y1;
+
+      if (_low < _top && _high >= _bottom) {
+        if (band_edge_count >= GEOFENCE_MAX_BAND_EDGES) {
+          band_edge_count = _start;
+          band_count = _p.first_band;
+          vertex_count = _first;
+          return false;
+        }
+        band_edges[band_edge_count++] = _e;
+      }
+    }
+  }
+  band_start[band_count++] = band_edge_count;
+
+  polygon_count++;
+  return true;
+}
+
+// -------------------------------------------
+// Method for testing a position in a polygon
+// -------------------------------------------
+bool VehicleGpsGeofence::contains(byte _id, float _lat, float _lon) {
+  if (_id >= polygon_count)
+    return false;
+
+  long _x, _y;
+  toLocal(_lat, _lon, &_x, &_y);
+  return containsLocal(polygons[_id], _x, _y);
+}
+
+// ----------------------------------------------------------------
+// Method for distance to the nearest polygon edge in meters
+// Returns -1 for an unknown polygon
+// ----------------------------------------------------------------
+float VehicleGpsGeofence::distanceToEdge(byte _id, float _lat, float _lon) {
+  if (_id >= polygon_count)
+    return -1;
+
+  long _x, _y;
+  toLocal(_lat, _lon, &_x, &_y);
+  return float(distanceLocal(polygons[_id], _x, _y, 0)) / GEOFENCE_DM_PER_METER;
+}
+
+// ------------------------------------------------------------------
+// Method for checking a fix against all polygons, the inside state
+// only changes once the fix is more than the hysteresis past the edge
+// Returns the number of polygons entered or exited
+// ------------------------------------------------------------------
+byte VehicleGpsGeofence::update(float _lat, float _lon) {
+  byte _events = 0;
+  long _x, _y;
+
+  if (!has_origin)
+    return 0;
+
+  toLocal(_lat, _lon, &_x, &_y);
+
+  for (byte i = 0; i < polygon_count; i++) {
+    polygon &_p = polygons[i];
+    bool _inside = _p.state & GEOFENCE_INSIDE;
+    long _lx = _x - _p.x;
+    long _ly = _y - _p.y;
+
+    // clear events of the previous fix
+    _p.state = _inside ? GEOFENCE_INSIDE : 0;
+
+    // far outside the bounding box needs no edge distance
+    bool _far = _lx < -hysteresis || _ly < -hysteresis ||
+                _lx > _p.width + hysteresis || _ly > _p.height + hysteresis;
+    bool _now = !_far && containsLocal(_p, _x, _y);
+
+    if (_now != _inside &&
+        (_far || distanceLocal(_p, _x, _y, hysteresis) >= hysteresis)) {
+      _p.state = _now ? GEOFENCE_INSIDE | GEOFENCE_ENTERED : GEOFENCE_EXITED;
+      _events++;
+    }
+  }
+  return _events;
+}
+
+#if defined(ARDUINO)
+byte VehicleGpsGeofence::update(VehicleGps &_gps) {
+  float _lat, _lon;
+
+  _gps.getPosition(&_lat, &_lon);
+  if (_lat == float(GPS_INVALID_FLOAT) || _lon == float(GPS_INVALID_FLOAT))
+    return 0;
+
+  return update(_lat, _lon);
+}
+#endif
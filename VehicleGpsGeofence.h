@@ -0,0 +1,173 @@
+/*
+  VehicleGpsGeofence - field boundary and no-spray zone containment.
+Copyright (C) 2011-2014 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VehicleGpsGeofence_h
+#define VehicleGpsGeofence_h
+
+// no Arduino dependency so logs can be replayed on a host
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include "VehicleGps.h"
+#else
+#include <stdint.h>
+#include <math.h>
+typedef uint8_t byte;
+#endif
+
+// storage, all polygons share the vertex, band and band edge pools
+// edit these here, the library and sketch must see the same values
+// RAM is about 22 bytes per polygon, 4 per vertex, 1 per band edge
+// and 2 per band, roughly 8 bytes per vertex with the default ratios
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega32U4__)
+// 2 KB parts, about 1 KB for a handful of small fields
+#define GEOFENCE_MAX_POLYGONS   6
+#define GEOFENCE_MAX_VERTICES   96
+#define GEOFENCE_MAX_BANDS      48
+#define GEOFENCE_MAX_BAND_EDGES 192
+#elif defined(__AVR__)
+// 8 KB parts like the ATmega2560, about 3 KB
+#define GEOFENCE_MAX_POLYGONS   24
+#define GEOFENCE_MAX_VERTICES   320
+#define GEOFENCE_MAX_BANDS      128
+#define GEOFENCE_MAX_BAND_EDGES 640
+#else
+// 32 bit boards and hosts replaying logs, about 40 KB
+#define GEOFENCE_MAX_POLYGONS   64
+#define GEOFENCE_MAX_VERTICES   4096
+#define GEOFENCE_MAX_BANDS      1536
+#define GEOFENCE_MAX_BAND_EDGES 8192
+#endif
+
+// bands per polygon grow with its vertex count so a query only visits
+// a few edges however detailed the boundary is
+#define GEOFENCE_EDGES_PER_BAND 4
+
+// local frame in decimeters, same sphere as VehicleGps::distanceBetween
+#define GEOFENCE_DM_PER_METER 10
+#define GEOFENCE_DM_PER_DEGREE 1112262.6
+#define GEOFENCE_MAX_SIZE 32767
+
+// default distance past the boundary before an enter/exit is reported
+#define GEOFENCE_HYSTERESIS 1.0
+
+// polygon state flags
+#define GEOFENCE_INSIDE  0x01
+#define GEOFENCE_ENTERED 0x02
+#define GEOFENCE_EXITED  0x04
+
+class VehicleGpsGeofence {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  // polygon with bounding box and horizontal bands of edges
+  struct polygon {
+    long x, y;
+    int16_t width, height;
+    int16_t band_height;
+    unsigned int first_vertex;
+    byte vertex_count;
+    unsigned int first_band;
+    byte bands;
+    byte state;
+  };
+  polygon polygons[GEOFENCE_MAX_POLYGONS];
+  byte polygon_count;
+
+  // vertices relative to their polygon corner in decimeters
+  int16_t vertex_x[GEOFENCE_MAX_VERTICES];
+  int16_t vertex_y[GEOFENCE_MAX_VERTICES];
+  unsigned int vertex_count;
+
+  // first band edge of every band, a polygon uses bands + 1 entries
+  unsigned int band_start[GEOFENCE_MAX_BANDS];
+  unsigned int band_count;
+
+  // edge index within polygon for every band it overlaps
+  byte band_edges[GEOFENCE_MAX_BAND_EDGES];
+  unsigned int band_edge_count;
+
+  // local frame origin and polygon under construction
+  float origin_latitude, origin_longitude;
+  float dm_per_degree_longitude;
+  bool has_origin;
+  bool is_building;
+  long first_x, first_y;
+
+  // hysteresis in decimeters
+  long hysteresis;
+
+  //---------------------------------------------------------------
+  // private member functions implemented in VehicleGpsGeofence.cpp
+  //---------------------------------------------------------------
+  void toLocal(float _lat, float _lon, long *_x, long *_y);
+  bool containsLocal(const polygon &_p, long _x, long _y);
+  long distanceLocal(const polygon &_p, long _x, long _y, long _limit);
+  long distanceToSegment(long _x, long _y, int _x1, int _y1, int _x2, int _y2);
+
+public:
+  // -------------------------------------------------------------
+  // public member functions implemented in VehicleGpsGeofence.cpp
+  // -------------------------------------------------------------
+
+  //Constructor
+  VehicleGpsGeofence();
+
+  // local frame, defaults to the first vertex added
+  bool setOrigin(float _lat, float _lon);
+  void setHysteresis(float _meters);
+  void clear();
+
+  // polygon construction, ids are assigned in order starting at 0
+  bool beginPolygon();
+  bool addVertex(float _lat, float _lon);
+  bool endPolygon();
+
+  // queries against a single polygon
+  bool contains(byte _id, float _lat, float _lon);
+  float distanceToEdge(byte _id, float _lat, float _lon);
+
+  // check a fix against all polygons, returns number of enter/exit events
+  byte update(float _lat, float _lon);
+#if defined(ARDUINO)
+  byte update(VehicleGps &_gps);
+#endif
+
+  // ----------------------------------------------------------
+  // public inline member functions implemented in this header
+  // ----------------------------------------------------------
+  inline byte getPolygons() {
+    return polygon_count;
+  }
+
+  // state after the last update()
+  inline bool isInside(byte _id) {
+    return _id < polygon_count && (polygons[_id].state & GEOFENCE_INSIDE);
+  }
+
+  inline bool entered(byte _id) {
+    return _id < polygon_count && (polygons[_id].state & GEOFENCE_ENTERED);
+  }
+
+  inline bool exited(byte _id) {
+    return _id < polygon_count && (polygons[_id].state & GEOFENCE_EXITED);
+  }
+};
+#endif